@@ -2,8 +2,8 @@
  * @file simpletest.h
  * @brief 简单单元测试
  * @author hzh
- * @version 1.6
- * @date 2020-05-26
+ * @version 1.7
+ * @date 2026-10-19
  */
 #ifndef SIMPLETEST_H_
 #define SIMPLETEST_H_
@@ -13,6 +13,16 @@
 #include <string.h>
 #include <time.h>
 
+#if defined(SIMPLETEST_ENABLE_BENCH_ENV) && defined(__linux__)
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#ifndef CPU_SET
+#error "SIMPLETEST_ENABLE_BENCH_ENV requires _GNU_SOURCE, define it when compiling"
+#endif
+#endif
+
 #if defined(WIN32)
 #include <windows.h>
 #define simpletest_gettick(tick)                                                                   \
@@ -32,6 +42,17 @@
     } while(0)
 #endif
 
+/// 基准测试环境使用单调时钟计时，统计包含调度等待在内的实际耗时
+#if defined(SIMPLETEST_ENABLE_BENCH_ENV) && defined(__linux__) && !defined(simpletest_gettick)
+#define simpletest_gettick(tick)                                                                   \
+    do                                                                                             \
+    {                                                                                              \
+        struct timespec cur_time;                                                                  \
+        clock_gettime(CLOCK_MONOTONIC, &cur_time);                                                 \
+        tick = (unsigned)(cur_time.tv_sec * 1000000ULL + cur_time.tv_nsec / 1000);                 \
+    } while(0)
+#endif
+
 /// 打印输出函数
 #ifndef simpletest_output
 #define simpletest_output(fmt, ...) printf(fmt, ##__VA_ARGS__)
@@ -51,6 +72,34 @@
     } while(0)
 #endif
 
+#if defined(SIMPLETEST_ENABLE_BENCH_ENV)
+/// 绑定的CPU掩码，第n位对应第n个核心，只能选择前64个核心，0表示绑定到当前所在核心
+#ifndef SIMPLETEST_BENCH_CPU_MASK
+#define SIMPLETEST_BENCH_CPU_MASK 0
+#endif
+
+/// 进程nice值，负数提升调度优先级(需要CAP_SYS_NICE)，0表示不修改
+#ifndef SIMPLETEST_BENCH_NICE
+#define SIMPLETEST_BENCH_NICE 0
+#endif
+
+/// 非0时预先触发栈缺页并锁定进程当前内存(需要CAP_IPC_LOCK或足够的RLIMIT_MEMLOCK)
+/// 之后分配的内存不锁定，避免锁定内存达到RLIMIT_MEMLOCK后malloc/mmap失败
+#ifndef SIMPLETEST_BENCH_LOCK_MEMORY
+#define SIMPLETEST_BENCH_LOCK_MEMORY 0
+#endif
+
+/// 预先触发缺页的栈大小
+#ifndef SIMPLETEST_BENCH_PREFAULT_STACK
+#define SIMPLETEST_BENCH_PREFAULT_STACK (256 * 1024)
+#endif
+
+/// CASE_REPEAT单次耗时的变异系数(标准差/均值)告警阈值，单位%
+/// 衡量的是同一次运行内各次迭代之间的波动，不比较多次运行之间的结果
+#ifndef SIMPLETEST_BENCH_VARIANCE
+#define SIMPLETEST_BENCH_VARIANCE 10
+#endif
+#endif
 
 /**
  * @brief 定义测试用例, 生成名为case的函数
@@ -89,13 +138,20 @@
     }                                                                                              \
     static void case_##case()
 
+/**
+ * @brief 定义重复执行的测试用例，输出总耗时及最差/平均/最好单次耗时
+ * @param case 测试用例名称
+ * @param count 重复次数
+ * @note 默认simpletest_gettick基于clock()，统计的是CPU时间，不含等待调度的时间；
+ * 定义SIMPLETEST_ENABLE_BENCH_ENV时在linux上改用CLOCK_MONOTONIC统计实际耗时
+ */
 #define CASE_REPEAT(case, count)                                                                   \
     static void case_##case();                                                                     \
     static void case()                                                                             \
     {                                                                                              \
         unsigned start_tick, end_tick, index;                                                      \
         unsigned worst_ = 0, best_ = 0xffffffff;                                                   \
-        double pass_ = 100;                                                                        \
+        double pass_ = 100, sum_ = 0, sqsum_ = 0;                                                  \
         if((count) == 0) return;                                                                   \
         if(simpletest_flag(SIMPLETEST_ENABLE_CASE_OUTPUT))                                         \
         {                                                                                          \
@@ -113,6 +169,8 @@
             interval_ = end_tick_ - start_tick_;                                                   \
             worst_ = interval_ > worst_ ? interval_ : worst_;                                      \
             best_ = interval_ < best_ ? interval_ : best_;                                         \
+            sum_ += interval_;                                                                     \
+            sqsum_ += (double)interval_ * interval_;                                               \
         }                                                                                          \
         simpletest_gettick(end_tick);                                                              \
         if(simpletest_count() > 1)                                                                 \
@@ -133,6 +191,7 @@
                             simpletest_count(), pass_, (end_tick-start_tick)/1000., worst_/1000.,  \
                             (end_tick-start_tick)/1000./(count), best_/1000.);                     \
         }                                                                                          \
+        simpletest_bench_check(#case, (count), sum_, sqsum_);                                      \
     }                                                                                              \
     static void case_##case()
 
@@ -197,6 +256,7 @@
     {                                                                                              \
         int index = 0;                                                                             \
         void (*units[])() = {__VA_ARGS__};                                                         \
+        simpletest_bench_setup();                                                                  \
         for(index = 0; index < sizeof(units) / sizeof(void*); ++index)                             \
         {                                                                                          \
             units[index]();                                                                        \
@@ -483,6 +543,32 @@ int simpletest_eq_mem(const void* m1, const void* m2, size_t len);
  */
 const char* simpletest_truncat_path(const char* path);
 
+/**
+ * @brief 输出主机信息(CPU型号、核心数、调频策略、负载)，便于跨机器比较耗时
+ */
+void simpletest_host_report();
+
+/**
+ * @brief 初始化基准测试环境，未定义SIMPLETEST_ENABLE_BENCH_ENV时为空操作
+ * 绑定CPU核心，按配置提升调度优先级、锁定内存，检查CPU调频策略并输出主机信息
+ */
+void simpletest_bench_setup();
+
+/**
+ * @brief 检查重复测试单次耗时的波动，变异系数超过SIMPLETEST_BENCH_VARIANCE时告警
+ * 平均耗时不足10个计时单位时受计时精度影响，不做检查；未定义SIMPLETEST_ENABLE_BENCH_ENV时为空操作
+ *
+ * @param name 测试用例名称
+ * @param count 重复次数
+ * @param sum 单次耗时之和
+ * @param sqsum 单次耗时平方和
+ *
+ * @return 耗时是否稳定
+ *   @retval 0 波动超过阈值
+ *   @retval 1 稳定或不做检查
+ */
+int simpletest_bench_check(const char* name, unsigned count, double sum, double sqsum);
+
 #define PRIV_SIMPLETEST_GET_N(x, n, ...) n
 #define PRIV_SIMPLETEST_GET(...) PRIV_SIMPLETEST_GET_N(__VA_ARGS__, 0)
 
@@ -495,6 +581,176 @@ enum SIMPLETEST_FLAG
     SIMPLETEST_ENABLE_ALL_OUTPUT  = 0x0007, /// 开启全部输出
 };
 
+#if defined(SIMPLETEST_ENABLE_BENCH_ENV) && defined(__linux__)
+#define PRIV_SIMPLETEST_CURRENT_CPU() sched_getcpu()
+#define PRIV_SIMPLETEST_BENCH_SETUP                                                                \
+    static void simpletest_bench_prefault()                                                        \
+    {                                                                                              \
+        volatile char stack[SIMPLETEST_BENCH_PREFAULT_STACK];                                      \
+        size_t index = 0;                                                                          \
+        for(index = 0; index < sizeof(stack); index += 4096)                                       \
+        {                                                                                          \
+            stack[index] = 0;                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+    void simpletest_bench_setup()                                                                  \
+    {                                                                                              \
+        unsigned long long mask = SIMPLETEST_BENCH_CPU_MASK;                                       \
+        cpu_set_t want, got;                                                                       \
+        char path[80], governor[32], cpus[256] = "";                                               \
+        int cpu = 0, len = 0, unknown = 0;                                                         \
+        int output =                                                                               \
+            simpletest_flag(SIMPLETEST_ENABLE_CASE_OUTPUT | SIMPLETEST_ENABLE_UNIT_OUTPUT);        \
+        CPU_ZERO(&want);                                                                           \
+        if(mask == 0)                                                                              \
+        {                                                                                          \
+            cpu = sched_getcpu();                                                                  \
+            if(cpu >= 0 && cpu < CPU_SETSIZE)                                                      \
+            {                                                                                      \
+                CPU_SET(cpu, &want);                                                               \
+            }                                                                                      \
+        }                                                                                          \
+        for(cpu = 0; cpu < 64; ++cpu)                                                              \
+        {                                                                                          \
+            if((mask >> cpu) & 1)                                                                  \
+            {                                                                                      \
+                CPU_SET(cpu, &want);                                                               \
+            }                                                                                      \
+        }                                                                                          \
+        if(CPU_COUNT(&want) == 0)                                                                  \
+        {                                                                                          \
+            simpletest_warn("BENCH: get current cpu failed: %s, skip pinning\n", strerror(errno)); \
+        }                                                                                          \
+        else if(sched_setaffinity(0, sizeof(want), &want) != 0)                                    \
+        {                                                                                          \
+            simpletest_warn("BENCH: set cpu affinity failed: %s\n", strerror(errno));              \
+        }                                                                                          \
+        if(sched_getaffinity(0, sizeof(got), &got) != 0)                                           \
+        {                                                                                          \
+            simpletest_warn("BENCH: get cpu affinity failed: %s\n", strerror(errno));              \
+            CPU_ZERO(&got);                                                                        \
+        }                                                                                          \
+        for(cpu = 0; cpu < CPU_SETSIZE; ++cpu)                                                     \
+        {                                                                                          \
+            if(!CPU_ISSET(cpu, &got))                                                              \
+            {                                                                                      \
+                continue;                                                                          \
+            }                                                                                      \
+            if(len < (int)sizeof(cpus) - 16)                                                       \
+            {                                                                                      \
+                len += snprintf(cpus + len, sizeof(cpus) - len, len ? ",%d" : "%d", cpu);          \
+            }                                                                                      \
+            else if(cpus[len - 1] != '.')                                                          \
+            {                                                                                      \
+                len += snprintf(cpus + len, sizeof(cpus) - len, ",...");                           \
+            }                                                                                      \
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", \
+                     cpu);                                                                         \
+            if(!simpletest_read_line(path, governor, sizeof(governor)))                            \
+            {                                                                                      \
+                if(!unknown)                                                                       \
+                {                                                                                  \
+                    simpletest_warn("BENCH: cpu%d governor unknown\n", cpu);                       \
+                    unknown = 1;                                                                   \
+                }                                                                                  \
+            }                                                                                      \
+            else if(strcmp(governor, "performance") != 0)                                          \
+            {                                                                                      \
+                simpletest_warn("BENCH: cpu%d governor is %s, not performance\n", cpu, governor);  \
+            }                                                                                      \
+        }                                                                                          \
+        if(CPU_COUNT(&want) != 0 && !CPU_EQUAL(&want, &got))                                       \
+        {                                                                                          \
+            simpletest_warn("BENCH: running on cpu %s, not the requested cpus\n", cpus);           \
+        }                                                                                          \
+        else if(CPU_COUNT(&want) != 0 && output)                                                   \
+        {                                                                                          \
+            simpletest_output("BENCH: pinned to cpu %s\n", cpus);                                  \
+        }                                                                                          \
+        if(SIMPLETEST_BENCH_NICE != 0)                                                             \
+        {                                                                                          \
+            if(setpriority(PRIO_PROCESS, 0, SIMPLETEST_BENCH_NICE) != 0)                           \
+            {                                                                                      \
+                simpletest_warn("BENCH: set nice %d failed: %s\n", SIMPLETEST_BENCH_NICE,          \
+                                strerror(errno));                                                  \
+            }                                                                                      \
+            else if(output)                                                                        \
+            {                                                                                      \
+                simpletest_output("BENCH: nice %d\n", SIMPLETEST_BENCH_NICE);                      \
+            }                                                                                      \
+        }                                                                                          \
+        if(SIMPLETEST_BENCH_LOCK_MEMORY)                                                           \
+        {                                                                                          \
+            simpletest_bench_prefault();                                                           \
+            if(mlockall(MCL_CURRENT) != 0)                                                         \
+            {                                                                                      \
+                simpletest_warn("BENCH: lock memory failed: %s\n", strerror(errno));               \
+            }                                                                                      \
+            else if(output)                                                                        \
+            {                                                                                      \
+                simpletest_output("BENCH: memory locked\n");                                       \
+            }                                                                                      \
+        }                                                                                          \
+        simpletest_host_report();                                                                  \
+    }
+#elif defined(SIMPLETEST_ENABLE_BENCH_ENV)
+#define PRIV_SIMPLETEST_CURRENT_CPU() 0
+#define PRIV_SIMPLETEST_BENCH_SETUP                                                                \
+    void simpletest_bench_setup()                                                                  \
+    {                                                                                              \
+        simpletest_warn("BENCH: environment control is only supported on linux\n");                \
+        simpletest_host_report();                                                                  \
+    }
+#else
+#define PRIV_SIMPLETEST_CURRENT_CPU() 0
+#define PRIV_SIMPLETEST_BENCH_SETUP                                                                \
+    void simpletest_bench_setup()                                                                  \
+    {                                                                                              \
+    }
+#endif
+
+#if defined(SIMPLETEST_ENABLE_BENCH_ENV)
+#define PRIV_SIMPLETEST_BENCH_CHECK                                                                \
+    static double simpletest_sqrt(double x)                                                        \
+    {                                                                                              \
+        double root = x > 1 ? x : 1;                                                               \
+        int index = 0;                                                                             \
+        if(x <= 0)                                                                                 \
+        {                                                                                          \
+            return 0;                                                                              \
+        }                                                                                          \
+        for(index = 0; index < 64; ++index)                                                        \
+        {                                                                                          \
+            root = (root + x / root) / 2;                                                          \
+        }                                                                                          \
+        return root;                                                                               \
+    }                                                                                              \
+    int simpletest_bench_check(const char* name, unsigned count, double sum, double sqsum)         \
+    {                                                                                              \
+        double mean = 0, cv = 0;                                                                   \
+        if(count < 2 || sum < 10.0 * count)                                                        \
+        {                                                                                          \
+            return 1;                                                                              \
+        }                                                                                          \
+        mean = sum / count;                                                                        \
+        cv = simpletest_sqrt(sqsum / count - mean * mean) / mean * 100;                            \
+        if(cv > SIMPLETEST_BENCH_VARIANCE)                                                         \
+        {                                                                                          \
+            simpletest_warn("BENCH: %s*%u: unstable, cv %0.2f%% > %g%% (mean %0.3f ms)\n", name,   \
+                            count, cv, (double)SIMPLETEST_BENCH_VARIANCE, mean / 1000.);           \
+            return 0;                                                                              \
+        }                                                                                          \
+        return 1;                                                                                  \
+    }
+#else
+#define PRIV_SIMPLETEST_BENCH_CHECK                                                                \
+    int simpletest_bench_check(const char* name, unsigned count, double sum, double sqsum)         \
+    {                                                                                              \
+        (void)name, (void)count, (void)sum, (void)sqsum;                                           \
+        return 1;                                                                                  \
+    }
+#endif
+
 /**
  * @brief 必须在主函数外执行一次，包含相关函数定义
  *
@@ -592,6 +848,68 @@ enum SIMPLETEST_FLAG
             ++p;                                                                                   \
         }                                                                                          \
         return path;                                                                               \
-    }
+    }                                                                                              \
+    static int simpletest_read_line(const char* path, char* buf, int size)                         \
+    {                                                                                              \
+        FILE* fp = fopen(path, "r");                                                               \
+        if(fp == NULL)                                                                             \
+        {                                                                                          \
+            return 0;                                                                              \
+        }                                                                                          \
+        if(fgets(buf, size, fp) == NULL)                                                           \
+        {                                                                                          \
+            fclose(fp);                                                                            \
+            return 0;                                                                              \
+        }                                                                                          \
+        fclose(fp);                                                                                \
+        buf[strcspn(buf, "\n")] = '\0';                                                            \
+        return 1;                                                                                  \
+    }                                                                                              \
+    void simpletest_host_report()                                                                  \
+    {                                                                                              \
+        char model[128] = "unknown", governor[32] = "unknown", load[64] = "unknown";               \
+        char line[256], path[80], count[16] = "unknown";                                           \
+        const char* value = NULL;                                                                  \
+        int cpus = 0, cpu = PRIV_SIMPLETEST_CURRENT_CPU();                                         \
+        double load1 = 0, load5 = 0, load15 = 0;                                                   \
+        FILE* fp = NULL;                                                                           \
+        if(cpu < 0)                                                                                \
+        {                                                                                          \
+            cpu = 0;                                                                               \
+        }                                                                                          \
+        fp = fopen("/proc/cpuinfo", "r");                                                          \
+        if(fp != NULL)                                                                             \
+        {                                                                                          \
+            while(fgets(line, sizeof(line), fp) != NULL)                                           \
+            {                                                                                      \
+                if(strncmp(line, "processor", 9) == 0)                                             \
+                {                                                                                  \
+                    ++cpus;                                                                        \
+                }                                                                                  \
+                else if(strncmp(line, "model name", 10) == 0 && (value = strchr(line, ':')))       \
+                {                                                                                  \
+                    value += strspn(value + 1, " \t") + 1;                                         \
+                    snprintf(model, sizeof(model), "%.*s", (int)strcspn(value, "\n"), value);      \
+                }                                                                                  \
+            }                                                                                      \
+            fclose(fp);                                                                            \
+        }                                                                                          \
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor",     \
+                 cpu);                                                                             \
+        simpletest_read_line(path, governor, sizeof(governor));                                    \
+        if(cpus > 0)                                                                               \
+        {                                                                                          \
+            snprintf(count, sizeof(count), "%d", cpus);                                            \
+        }                                                                                          \
+        if(simpletest_read_line("/proc/loadavg", line, sizeof(line))                               \
+           && sscanf(line, "%lf %lf %lf", &load1, &load5, &load15) == 3)                           \
+        {                                                                                          \
+            snprintf(load, sizeof(load), "%0.2f %0.2f %0.2f", load1, load5, load15);               \
+        }                                                                                          \
+        simpletest_output("HOST: %s, %s cpus, cpu%d governor %s, load %s\n", model, count, cpu,    \
+                          governor, load);                                                         \
+    }                                                                                              \
+    PRIV_SIMPLETEST_BENCH_SETUP                                                                    \
+    PRIV_SIMPLETEST_BENCH_CHECK
 
 #endif // SIMPLETEST_H_
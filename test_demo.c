@@ -10,6 +10,11 @@ static double divide(double a, double b)
     return a / b;
 }
 
+static int compare_int(const void* a, const void* b)
+{
+    return *(const int*)a - *(const int*)b;
+}
+
 static int step_ = 0;
 static void next_step()
 {
@@ -45,6 +50,32 @@ CASE_REPEAT(test_concat, 10000)
     EXPECT_EQ_MEM("abcdef", string, 6);
 }
 
+CASE_REPEAT(test_sort, 100)
+{
+    int array[4096];
+    int index = 0;
+    for(index = 0; index < 4096; ++index)
+    {
+        array[index] = index * 7919 % 4096;
+    }
+    qsort(array, 4096, sizeof(int), compare_int);
+    EXPECT_EQ_INT(0, array[0]);
+    EXPECT_EQ_INT(4095, array[4095]);
+}
+
+CASE(test_bench_check)
+{
+    /* 10次平均100微秒，标准差0/5/20微秒 */
+    EXPECT(simpletest_bench_check("steady", 10, 1000, 100000));
+    EXPECT(simpletest_bench_check("quiet", 10, 1000, 100250));
+#if defined(SIMPLETEST_ENABLE_BENCH_ENV)
+    EXPECT_FALSE(simpletest_bench_check("noisy", 10, 1000, 104000));
+#endif
+    /* 平均不足10个计时单位或次数不足时不做检查 */
+    EXPECT(simpletest_bench_check("tiny", 10, 50, 2500));
+    EXPECT(simpletest_bench_check("once", 1, 1000, 1000000));
+}
+
 CASE(test_step)
 {
     REQUIRE(step_ == 0);
@@ -59,4 +90,6 @@ UNIT(test_demo_entry,
         test_sum,
         test_divide,
         test_concat,
+        test_sort,
+        test_bench_check,
         test_step)